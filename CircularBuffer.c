@@ -1,9 +1,12 @@
 #include "CircularBuffer.h"
+#include "Crc32c.h"
 #ifdef __linux__
 #include <pthread.h>
 #endif
 
 static void incrementRead(circularBuffer_t *pBuffer);
+static int writeByte(circularBuffer_t *pBuffer, uint8_t byte);
+static size_t usedSpace(circularBuffer_t *pBuffer);
 
 /********************
 * Name: CircularBufferInit
@@ -21,6 +24,8 @@ void CircularBufferInit(circularBuffer_t *pCircularBuffer, uint8_t *pBuf, size_t
     pCircularBuffer->pWrite = pCircularBuffer->pStart;
     pCircularBuffer->pRead = pCircularBuffer->pStart;
     pCircularBuffer->pMark = pCircularBuffer->pStart;
+    pCircularBuffer->writeCrc = 0xFFFFFFFF;
+    pCircularBuffer->writeCrcEnabled = 0;
     
     #ifdef __linux__
     pthread_mutex_init(&pCircularBuffer->mutex, NULL);
@@ -88,25 +93,14 @@ int CircularBufferIsEmpty(circularBuffer_t *pBuffer){
 * Return: 0 if successful, -1 if the buffer was full and the read pointer was incremented
 **********************/
 int CircularBufferWriteByte(circularBuffer_t *pBuffer, uint8_t byte){
-    int retVal = 0;
+    int retVal;
     #ifdef __linux__
     pthread_mutex_lock(&pBuffer->mutex);
     #endif
-    *(pBuffer->pWrite) = byte;
-    pBuffer->pWrite++;
-    if(pBuffer->pWrite > pBuffer->pEnd){
-        pBuffer->pWrite = pBuffer->pStart;
-    }
-    if(pBuffer->pWrite == pBuffer->pMark){
-        pBuffer->pMark++;
-        if(pBuffer->pMark > pBuffer->pEnd){
-            pBuffer->pMark = pBuffer->pStart;
-        }
-    }
-    if(pBuffer->pWrite == pBuffer->pRead){
-        incrementRead(pBuffer);
-        retVal = -1;
+    if(pBuffer->writeCrcEnabled){
+        pBuffer->writeCrc = Crc32cStepByte(pBuffer->writeCrc, byte);
     }
+    retVal = writeByte(pBuffer, byte);
     #ifdef __linux__
     pthread_mutex_unlock(&pBuffer->mutex);
     #endif
@@ -116,6 +110,7 @@ int CircularBufferWriteByte(circularBuffer_t *pBuffer, uint8_t byte){
 /********************
 * Name: CircularBufferWriteNBytes
 * Description: Writes multiple bytes to the circular buffer.
+               The bytes are written atomically with respect to the other writers.
 * Input:
 *   pBuffer: pointer to the circular buffer structure
 *   pBytes: pointer to the array of bytes to write
@@ -125,9 +120,18 @@ int CircularBufferWriteByte(circularBuffer_t *pBuffer, uint8_t byte){
 **********************/
 int CircularBufferWriteNBytes(circularBuffer_t *pBuffer, uint8_t *pBytes, size_t nBytes){
     int retVal = 0;
-    for(int i = 0; i < nBytes; i++){
-        retVal += CircularBufferWriteByte(pBuffer, pBytes[i]);
+    #ifdef __linux__
+    pthread_mutex_lock(&pBuffer->mutex);
+    #endif
+    if(pBuffer->writeCrcEnabled){
+        pBuffer->writeCrc = Crc32cUpdateRegister(pBuffer->writeCrc, pBytes, nBytes);
+    }
+    for(size_t i = 0; i < nBytes; i++){
+        retVal += writeByte(pBuffer, pBytes[i]);
     }
+    #ifdef __linux__
+    pthread_mutex_unlock(&pBuffer->mutex);
+    #endif
     return retVal;
 }
 
@@ -190,6 +194,104 @@ void CircularBufferRewind(circularBuffer_t *pBuffer) {
     #endif
 }
 
+/********************
+* Name: CircularBufferCrc32c
+* Description: Computes the CRC32C of a range of the readable bytes, without
+               consuming them and without copying them out of the buffer.
+               The range may wrap around the end of the buffer.
+               The crc pointed by pCrc is updated, so it must be set to 0 for a new
+               crc, or to the result of a previous call to continue it.
+* Input:
+*   pBuffer: pointer to the circular buffer structure
+*   offset: offset of the first byte of the range from the read position
+*   nBytes: number of bytes in the range
+*   pCrc: pointer to the crc to update
+* Output:
+*   pCrc: the updated crc
+* Return: 0 if successful, -1 if the range exceeds the readable bytes
+**********************/
+int CircularBufferCrc32c(circularBuffer_t *pBuffer, size_t offset, size_t nBytes, uint32_t *pCrc){
+    int retVal = 0;
+    size_t size, firstChunk;
+    uint8_t *pFrom;
+    #ifdef __linux__
+    pthread_mutex_lock(&pBuffer->mutex);
+    #endif
+    size = pBuffer->pEnd - pBuffer->pStart + 1;
+    if(offset > usedSpace(pBuffer) || nBytes > usedSpace(pBuffer) - offset){
+        retVal = -1;
+    }else{
+        pFrom = pBuffer->pStart + (pBuffer->pRead - pBuffer->pStart + offset) % size;
+        firstChunk = pBuffer->pEnd - pFrom + 1;
+        if(firstChunk > nBytes){
+            firstChunk = nBytes;
+        }
+        *pCrc = Crc32cUpdate(*pCrc, pFrom, firstChunk);
+        *pCrc = Crc32cUpdate(*pCrc, pBuffer->pStart, nBytes - firstChunk);
+    }
+    #ifdef __linux__
+    pthread_mutex_unlock(&pBuffer->mutex);
+    #endif
+    return retVal;
+}
+
+/********************
+* Name: CircularBufferStartWriteCrc
+* Description: Resets the write crc and starts updating it with every written byte.
+* Input:
+*   pBuffer: pointer to the circular buffer structure
+* Output: <>
+* Return: <>
+**********************/
+void CircularBufferStartWriteCrc(circularBuffer_t *pBuffer){
+    #ifdef __linux__
+    pthread_mutex_lock(&pBuffer->mutex);
+    #endif
+    pBuffer->writeCrc = 0xFFFFFFFF;
+    pBuffer->writeCrcEnabled = 1;
+    #ifdef __linux__
+    pthread_mutex_unlock(&pBuffer->mutex);
+    #endif
+}
+
+/********************
+* Name: CircularBufferStopWriteCrc
+* Description: Stops updating the write crc. The last value is kept.
+* Input:
+*   pBuffer: pointer to the circular buffer structure
+* Output: <>
+* Return: <>
+**********************/
+void CircularBufferStopWriteCrc(circularBuffer_t *pBuffer){
+    #ifdef __linux__
+    pthread_mutex_lock(&pBuffer->mutex);
+    #endif
+    pBuffer->writeCrcEnabled = 0;
+    #ifdef __linux__
+    pthread_mutex_unlock(&pBuffer->mutex);
+    #endif
+}
+
+/********************
+* Name: CircularBufferGetWriteCrc
+* Description: Returns the CRC32C of the bytes written since CircularBufferStartWriteCrc.
+* Input:
+*   pBuffer: pointer to the circular buffer structure
+* Output: <>
+* Return: the write crc
+**********************/
+uint32_t CircularBufferGetWriteCrc(circularBuffer_t *pBuffer){
+    uint32_t crc;
+    #ifdef __linux__
+    pthread_mutex_lock(&pBuffer->mutex);
+    #endif
+    crc = ~pBuffer->writeCrc;
+    #ifdef __linux__
+    pthread_mutex_unlock(&pBuffer->mutex);
+    #endif
+    return crc;
+}
+
 /********************
 * Name: incrementRead
 * Description: Increments the read pointer, wrapping around if necessary.
@@ -203,4 +305,48 @@ static void incrementRead(circularBuffer_t *pBuffer){
     if(pBuffer->pRead > pBuffer->pEnd){
         pBuffer->pRead = pBuffer->pStart;
     }
+}
+
+/********************
+* Name: usedSpace
+* Description: Returns the number of readable bytes. The caller must hold the mutex.
+* Input:
+*   pBuffer: pointer to the circular buffer structure
+* Output: <>
+* Return: the number of readable bytes
+**********************/
+static size_t usedSpace(circularBuffer_t *pBuffer){
+    if(pBuffer->pWrite >= pBuffer->pRead){
+        return pBuffer->pWrite - pBuffer->pRead;
+    }
+    return (pBuffer->pEnd - pBuffer->pStart + 1) - (pBuffer->pRead - pBuffer->pWrite);
+}
+
+/********************
+* Name: writeByte
+* Description: Writes a single byte, see CircularBufferWriteByte. The caller must hold the mutex.
+* Input:
+*   pBuffer: pointer to the circular buffer structure
+*   byte: the byte to write
+* Output: <>
+* Return: 0 if successful, -1 if the buffer was full and the read pointer was incremented
+**********************/
+static int writeByte(circularBuffer_t *pBuffer, uint8_t byte){
+    int retVal = 0;
+    *(pBuffer->pWrite) = byte;
+    pBuffer->pWrite++;
+    if(pBuffer->pWrite > pBuffer->pEnd){
+        pBuffer->pWrite = pBuffer->pStart;
+    }
+    if(pBuffer->pWrite == pBuffer->pMark){
+        pBuffer->pMark++;
+        if(pBuffer->pMark > pBuffer->pEnd){
+            pBuffer->pMark = pBuffer->pStart;
+        }
+    }
+    if(pBuffer->pWrite == pBuffer->pRead){
+        incrementRead(pBuffer);
+        retVal = -1;
+    }
+    return retVal;
 }
\ No newline at end of file
@@ -17,6 +17,8 @@ typedef struct circularBuffer_s{
     uint8_t *pWrite;
     uint8_t *pRead;
     uint8_t *pMark;
+    uint32_t writeCrc; /* raw crc32c register, inverted crc */
+    int writeCrcEnabled;
     #ifdef __linux__
     pthread_mutex_t mutex;
     #endif
@@ -30,3 +32,7 @@ int CircularBufferWriteNBytes(circularBuffer_t *pBuffer, uint8_t *pBytes, size_t
 uint8_t CircularBufferReadByte(circularBuffer_t *pBuffer);
 void CircularBufferSetMarker(circularBuffer_t *pBuffer);
 void CircularBufferRewind(circularBuffer_t *pBuffer);
+int CircularBufferCrc32c(circularBuffer_t *pBuffer, size_t offset, size_t nBytes, uint32_t *pCrc);
+void CircularBufferStartWriteCrc(circularBuffer_t *pBuffer);
+void CircularBufferStopWriteCrc(circularBuffer_t *pBuffer);
+uint32_t CircularBufferGetWriteCrc(circularBuffer_t *pBuffer);
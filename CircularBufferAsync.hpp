@@ -0,0 +1,356 @@
+/***************
+ * CircularBufferAsync.hpp
+ *
+ * C++20 coroutine awaitables on top of circularBuffer_t.
+ * Requires C++20 (<coroutine>, <span>).
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+extern "C"
+{
+    #include "CircularBuffer.h"
+}
+
+/********************
+* Name: AsyncCircularBuffer
+* Description: Wraps an initialized circularBuffer_t so that coroutines can
+               co_await reads and writes.
+               A read suspends until enough bytes have been written, a write
+               suspends until there is enough free space, so nothing is ever
+               overwritten. Waiting coroutines are served in FIFO order: the side
+               that makes room or provides data moves the bytes for the waiting
+               coroutine and resumes it directly, no polling is involved.
+               Reads and writes bigger than the buffer are transferred in chunks.
+               Every co_await returns the number of bytes transferred, which is
+               less than requested only if the buffer was closed.
+               While wrapped, the buffer must only be accessed through this class.
+               Lifecycle:
+               - close() resumes every waiting coroutine with the bytes transferred
+                 so far; after it, reads and writes transfer what they can and
+                 never wait.
+               - A waiting coroutine may be destroyed (e.g. cancelled by its
+                 executor): its request is removed from the queue. It must not
+                 be destroyed while another thread may be resuming it.
+                 A request may already be partly served when it is destroyed:
+                 the bytes a cancelled read already took out of the buffer are
+                 lost, and the bytes a cancelled write already put in the buffer
+                 stay there and will be read as any other byte. To stop without
+                 losing track of data, call close() and use the returned counts.
+               - This object must outlive every coroutine awaiting it, and no
+                 coroutine may be waiting when it is destroyed: call close() and
+                 let them finish, or destroy them, first.
+**********************/
+class AsyncCircularBuffer{
+public:
+    using resumer_t = std::function<void(std::coroutine_handle<>)>;
+
+private:
+    struct request_t{
+        uint8_t *pData;
+        size_t size;
+        size_t done;
+        std::coroutine_handle<> handle;
+        bool queued;
+    };
+
+    class transferAwaitable{
+    public:
+        transferAwaitable(const transferAwaitable &) = delete;
+        transferAwaitable &operator=(const transferAwaitable &) = delete;
+
+        ~transferAwaitable(){
+            withdraw();
+        }
+
+        bool await_ready() const noexcept{
+            return request.size == 0;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle){
+            request.handle = handle;
+            suspended = true;
+            return owner.suspend(request, queue);
+        }
+
+    protected:
+        transferAwaitable(AsyncCircularBuffer &owner, std::deque<request_t *> &queue, uint8_t *pData, size_t size)
+            : owner(owner), queue(queue), request{pData, size, 0, {}, false}, suspended(false){
+        }
+
+        /* Removes the request from the queue if its coroutine is destroyed while waiting.
+           The bytes already transferred are not undone, see the class description. */
+        void withdraw(){
+            if(suspended){
+                std::lock_guard<std::mutex> lock(owner.mutex);
+                if(request.queued){
+                    queue.erase(std::find(queue.begin(), queue.end(), &request));
+                    request.queued = false;
+                }
+                suspended = false;
+            }
+        }
+
+        AsyncCircularBuffer &owner;
+        std::deque<request_t *> &queue;
+        request_t request;
+        bool suspended;
+    };
+
+public:
+    class readAwaitable : public transferAwaitable{
+    public:
+        readAwaitable(AsyncCircularBuffer &owner, std::span<uint8_t> bytes)
+            : transferAwaitable(owner, owner.readers, bytes.data(), bytes.size()){
+        }
+
+        size_t await_resume() const noexcept{
+            return this->request.done;
+        }
+    };
+
+    class readNAwaitable : public transferAwaitable{
+    public:
+        readNAwaitable(AsyncCircularBuffer &owner, size_t nBytes)
+            : transferAwaitable(owner, owner.readers, nullptr, nBytes), bytes(nBytes){
+            this->request.pData = bytes.data();
+        }
+
+        ~readNAwaitable(){
+            //before bytes is freed
+            this->withdraw();
+        }
+
+        std::vector<uint8_t> await_resume() noexcept{
+            bytes.resize(this->request.done);
+            return std::move(bytes);
+        }
+
+    private:
+        std::vector<uint8_t> bytes;
+    };
+
+    class writeAwaitable : public transferAwaitable{
+    public:
+        writeAwaitable(AsyncCircularBuffer &owner, std::span<const uint8_t> bytes)
+            : transferAwaitable(owner, owner.writers, const_cast<uint8_t *>(bytes.data()), bytes.size()){
+        }
+
+        size_t await_resume() const noexcept{
+            return this->request.done;
+        }
+    };
+
+    /********************
+    * Name: AsyncCircularBuffer
+    * Description: Wraps an already initialized circular buffer.
+                   By default a waiting coroutine is resumed directly on the thread
+                   that completed its transfer; pass a resumer to hand it to an
+                   executor instead.
+                   Direct resumption goes through a per thread run queue drained by
+                   the outermost read, write or close on the thread, so coroutines
+                   resuming each other do not grow the stack.
+    * Input:
+    *   buffer: the circular buffer to wrap, it must outlive this object
+    *   resumer: called with every coroutine to resume, outside of any lock;
+                 empty for direct resumption
+    **********************/
+    explicit AsyncCircularBuffer(circularBuffer_t &buffer, resumer_t resumer = nullptr)
+        : buffer(buffer), resumer(std::move(resumer)){
+    }
+
+    ~AsyncCircularBuffer(){
+        assert(readers.empty() && writers.empty());
+    }
+
+    AsyncCircularBuffer(const AsyncCircularBuffer &) = delete;
+    AsyncCircularBuffer &operator=(const AsyncCircularBuffer &) = delete;
+
+    /********************
+    * Name: read
+    * Description: co_await ring.read(n) returns a std::vector with the next n bytes,
+                   or fewer if the buffer is closed.
+    **********************/
+    readNAwaitable read(size_t nBytes){
+        return readNAwaitable(*this, nBytes);
+    }
+
+    /********************
+    * Name: read
+    * Description: co_await ring.read(span) fills the span with the next bytes and
+                   returns how many were read, the whole span unless the buffer is closed.
+                   The span must stay valid until the co_await completes.
+    **********************/
+    readAwaitable read(std::span<uint8_t> bytes){
+        return readAwaitable(*this, bytes);
+    }
+
+    /********************
+    * Name: write
+    * Description: co_await ring.write(span) writes the span and returns how many
+                   bytes were written, the whole span unless the buffer is closed.
+                   The span must stay valid until the co_await completes.
+    **********************/
+    writeAwaitable write(std::span<const uint8_t> bytes){
+        return writeAwaitable(*this, bytes);
+    }
+
+    /********************
+    * Name: close
+    * Description: Resumes every waiting coroutine with the bytes transferred so far.
+                   From now on reads and writes transfer what they can without waiting.
+    **********************/
+    void close(){
+        std::vector<std::coroutine_handle<>> ready;
+        std::unique_lock<std::mutex> lock(mutex);
+
+        closed = true;
+        for(std::deque<request_t *> *pQueue : {&readers, &writers}){
+            for(request_t *pRequest : *pQueue){
+                pRequest->queued = false;
+                ready.push_back(pRequest->handle);
+            }
+            pQueue->clear();
+        }
+        lock.unlock();
+
+        resumeAll(ready);
+    }
+
+    bool isClosed(){
+        std::lock_guard<std::mutex> lock(mutex);
+        return closed;
+    }
+
+private:
+    struct runQueue_t{
+        std::deque<std::coroutine_handle<>> handles;
+        bool draining = false;
+    };
+
+    static runQueue_t &threadRunQueue(){
+        static thread_local runQueue_t runQueue;
+        return runQueue;
+    }
+
+    /********************
+    * Name: resumeAll
+    * Description: Hands the coroutines to the resumer or, for direct resumption,
+                   to the run queue of this thread. Only the outermost call on the
+                   thread drains the queue: calls made by the coroutines it resumes
+                   just append to it, so the stack depth stays bounded.
+    **********************/
+    void resumeAll(const std::vector<std::coroutine_handle<>> &ready){
+        if(resumer){
+            for(std::coroutine_handle<> handle : ready){
+                resumer(handle);
+            }
+            return;
+        }
+
+        runQueue_t &runQueue = threadRunQueue();
+        runQueue.handles.insert(runQueue.handles.end(), ready.begin(), ready.end());
+        if(runQueue.draining){
+            return;
+        }
+        runQueue.draining = true;
+        while(!runQueue.handles.empty()){
+            std::coroutine_handle<> handle = runQueue.handles.front();
+            runQueue.handles.pop_front();
+            handle.resume();
+        }
+        runQueue.draining = false;
+    }
+
+    /********************
+    * Name: suspend
+    * Description: Queues the request, moves as many bytes as possible for all the
+                   queued requests and resumes the completed ones.
+                   The request must not be accessed after the lock is released,
+                   as it may already have been resumed by another thread.
+    * Return: false if the request completed and the caller must not suspend
+    **********************/
+    bool suspend(request_t &request, std::deque<request_t *> &queue){
+        std::vector<std::coroutine_handle<>> ready;
+        std::unique_lock<std::mutex> lock(mutex);
+        bool completed;
+
+        queue.push_back(&request);
+        request.queued = true;
+        pump(ready);
+        completed = (request.done == request.size) || closed;
+        if(closed && request.queued){
+            //nothing will make progress for it anymore
+            queue.erase(std::find(queue.begin(), queue.end(), &request));
+            request.queued = false;
+            ready.push_back(request.handle);
+        }
+        if(completed){
+            ready.erase(std::find(ready.begin(), ready.end(), request.handle));
+        }
+        lock.unlock();
+
+        resumeAll(ready);
+        return !completed;
+    }
+
+    void pump(std::vector<std::coroutine_handle<>> &ready){
+        bool progress = true;
+        while(progress){
+            progress = serve(readers, ready, &AsyncCircularBuffer::readSome);
+            progress = serve(writers, ready, &AsyncCircularBuffer::writeSome) || progress;
+        }
+    }
+
+    bool serve(std::deque<request_t *> &queue, std::vector<std::coroutine_handle<>> &ready,
+               size_t (AsyncCircularBuffer::*transfer)(request_t &)){
+        bool progress = false;
+        while(!queue.empty()){
+            request_t *pRequest = queue.front();
+            size_t n = (this->*transfer)(*pRequest);
+            pRequest->done += n;
+            progress = progress || (n > 0);
+            if(pRequest->done < pRequest->size){
+                break;
+            }
+            queue.pop_front();
+            pRequest->queued = false;
+            ready.push_back(pRequest->handle);
+        }
+        return progress;
+    }
+
+    size_t readSome(request_t &request){
+        size_t capacity = buffer.pEnd - buffer.pStart;
+        size_t used = capacity - CircularBufferFreeSpace(&buffer);
+        size_t n = std::min(request.size - request.done, used);
+        for(size_t i = 0; i < n; i++){
+            request.pData[request.done + i] = CircularBufferReadByte(&buffer);
+        }
+        return n;
+    }
+
+    size_t writeSome(request_t &request){
+        size_t n = std::min(request.size - request.done, CircularBufferFreeSpace(&buffer));
+        CircularBufferWriteNBytes(&buffer, request.pData + request.done, n);
+        return n;
+    }
+
+    circularBuffer_t &buffer;
+    resumer_t resumer;
+    std::mutex mutex;
+    bool closed = false;
+    std::deque<request_t *> readers;
+    std::deque<request_t *> writers;
+};
@@ -0,0 +1,12 @@
+/***************
+ * Crc32c.h
+ * 
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t Crc32cUpdate(uint32_t crc, const uint8_t *pData, size_t nBytes);
+uint32_t Crc32cUpdateSoftware(uint32_t crc, const uint8_t *pData, size_t nBytes);
+uint32_t Crc32cUpdateRegister(uint32_t reg, const uint8_t *pData, size_t nBytes);
+uint32_t Crc32cStepByte(uint32_t reg, uint8_t byte);
@@ -0,0 +1,346 @@
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <vector>
+
+#include "CircularBufferAsync.hpp"
+
+#include "CppUTest/TestHarness.h"   // IWYU pragma: keep
+#include "CppUTest/UtestMacros.h"
+
+
+
+struct detachedTask{
+    struct promise_type{
+        detachedTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+struct ownedTask{
+    struct promise_type{
+        ownedTask get_return_object() noexcept { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() { std::terminate(); }
+    };
+    std::coroutine_handle<promise_type> handle;
+};
+
+static ownedTask ownedReadTask(AsyncCircularBuffer &ring, size_t nBytes, int &done)
+{
+    std::vector<uint8_t> bytes = co_await ring.read(nBytes);
+    done = 1;
+}
+
+static ownedTask ownedWriteTask(AsyncCircularBuffer &ring, std::vector<uint8_t> bytes, int &done)
+{
+    co_await ring.write(bytes);
+    done = 1;
+}
+
+static detachedTask writeCountTask(AsyncCircularBuffer &ring, std::vector<uint8_t> bytes, size_t &written, int &done)
+{
+    written = co_await ring.write(bytes);
+    done = 1;
+}
+
+static detachedTask writeTask(AsyncCircularBuffer &ring, std::vector<uint8_t> bytes, int &done)
+{
+    co_await ring.write(bytes);
+    done = 1;
+}
+
+static detachedTask readTask(AsyncCircularBuffer &ring, size_t nBytes, std::vector<uint8_t> &bytes, int &done)
+{
+    bytes = co_await ring.read(nBytes);
+    done = 1;
+}
+
+static detachedTask readSpanTask(AsyncCircularBuffer &ring, std::vector<uint8_t> &bytes, int &done)
+{
+    co_await ring.read(std::span<uint8_t>(bytes));
+    done = 1;
+}
+
+static detachedTask loopWriteTask(AsyncCircularBuffer &ring, size_t nWrites, size_t writeSize, int &done)
+{
+    std::vector<uint8_t> bytes(writeSize);
+    size_t next = 0;
+    for(size_t i = 0; i < nWrites; i++){
+        for(size_t j = 0; j < writeSize; j++){
+            bytes[j] = next++;
+        }
+        co_await ring.write(bytes);
+    }
+    done = 1;
+}
+
+static detachedTask loopReadTask(AsyncCircularBuffer &ring, size_t nReads, size_t readSize, size_t &errors, int &done)
+{
+    size_t next = 0;
+    for(size_t i = 0; i < nReads; i++){
+        std::vector<uint8_t> bytes = co_await ring.read(readSize);
+        for(uint8_t byte : bytes){
+            if(byte != (uint8_t)next++){
+                errors++;
+            }
+        }
+    }
+    done = 1;
+}
+
+static std::vector<uint8_t> sequence(size_t nBytes, uint8_t first)
+{
+    std::vector<uint8_t> bytes(nBytes);
+    for(size_t i = 0; i < nBytes; i++){
+        bytes[i] = first + i;
+    }
+    return bytes;
+}
+
+TEST_GROUP(CircularBufferAsync)
+{
+    static const ssize_t bufferSize = 10;
+    uint8_t buffer[bufferSize];
+    circularBuffer_t circularBuffer;
+    void setup()
+    {
+        CircularBufferInit(&circularBuffer, buffer, bufferSize);
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST(CircularBufferAsync, readCompletesWhenDataIsAvailable)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int written = 0, read = 0;
+
+    writeTask(ring, sequence(5, 'A'), written);
+    CHECK_EQUAL(1, written);
+    readTask(ring, 5, readBytes, read);
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(5, 'A') == readBytes);
+}
+
+TEST(CircularBufferAsync, readWaitsForEnoughBytes)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int written = 0, read = 0;
+
+    readTask(ring, 4, readBytes, read);
+    CHECK_EQUAL(0, read);
+    writeTask(ring, sequence(2, 'A'), written);
+    CHECK_EQUAL(0, read);
+    writeTask(ring, sequence(2, 'C'), written);
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(4, 'A') == readBytes);
+    CHECK_EQUAL(1, CircularBufferIsEmpty(&circularBuffer));
+}
+
+TEST(CircularBufferAsync, writeWaitsForFreeSpaceWithoutOverwriting)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int written = 0, read = 0;
+
+    writeTask(ring, sequence(25, 'a'), written);
+    CHECK_EQUAL(0, written);
+    CHECK_EQUAL(0, CircularBufferFreeSpace(&circularBuffer));
+    BYTES_EQUAL('a', *circularBuffer.pRead);
+
+    readTask(ring, 25, readBytes, read);
+    CHECK_EQUAL(1, written);
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(25, 'a') == readBytes);
+}
+
+TEST(CircularBufferAsync, readersAreServedInOrder)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> first(3), second(3);
+    int written = 0, firstRead = 0, secondRead = 0;
+
+    readSpanTask(ring, first, firstRead);
+    readSpanTask(ring, second, secondRead);
+    writeTask(ring, sequence(4, 'A'), written);
+    CHECK_EQUAL(1, firstRead);
+    CHECK_EQUAL(0, secondRead);
+    writeTask(ring, sequence(2, 'E'), written);
+    CHECK_EQUAL(1, secondRead);
+    CHECK(sequence(3, 'A') == first);
+    CHECK(sequence(3, 'D') == second);
+}
+
+TEST(CircularBufferAsync, resumerIsUsedForWaitingCoroutines)
+{
+    std::vector<std::coroutine_handle<>> queued;
+    AsyncCircularBuffer ring(circularBuffer, [&queued](std::coroutine_handle<> handle){
+        queued.push_back(handle);
+    });
+    std::vector<uint8_t> readBytes;
+    int written = 0, read = 0;
+
+    readTask(ring, 2, readBytes, read);
+    writeTask(ring, sequence(2, 'A'), written);
+    CHECK_EQUAL(1, written);
+    CHECK_EQUAL(0, read);
+    CHECK_EQUAL(1, queued.size());
+    queued[0].resume();
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(2, 'A') == readBytes);
+}
+
+TEST(CircularBufferAsync, producerAndConsumerOnDifferentThreads)
+{
+    const size_t nBytes = 10000;
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int written = 0, read = 0;
+
+    std::thread consumer([&](){ readTask(ring, nBytes, readBytes, read); });
+    std::thread producer([&](){ writeTask(ring, sequence(nBytes, 0), written); });
+    consumer.join();
+    producer.join();
+
+    CHECK_EQUAL(1, written);
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(nBytes, 0) == readBytes);
+}
+
+TEST(CircularBufferAsync, closeResumesReadersWithShortCount)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int written = 0, read = 0;
+
+    readTask(ring, 5, readBytes, read);
+    writeTask(ring, sequence(2, 'A'), written);
+    CHECK_EQUAL(0, read);
+    ring.close();
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(2, 'A') == readBytes);
+}
+
+TEST(CircularBufferAsync, closeResumesWritersWithShortCount)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    size_t writtenBytes = 0;
+    int written = 0;
+
+    writeCountTask(ring, sequence(25, 'a'), writtenBytes, written);
+    CHECK_EQUAL(0, written);
+    ring.close();
+    CHECK_EQUAL(1, written);
+    CHECK_EQUAL(bufferSize - 1, writtenBytes);
+}
+
+TEST(CircularBufferAsync, operationsDoNotWaitAfterClose)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    size_t writtenBytes = 0;
+    int written = 0, read = 0;
+
+    ring.close();
+    CHECK(ring.isClosed());
+    writeCountTask(ring, sequence(25, 'a'), writtenBytes, written);
+    CHECK_EQUAL(1, written);
+    CHECK_EQUAL(bufferSize - 1, writtenBytes);
+    readTask(ring, 25, readBytes, read);
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(bufferSize - 1, 'a') == readBytes);
+}
+
+TEST(CircularBufferAsync, destroyedReaderIsRemovedFromQueue)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int written = 0, cancelledRead = 0, read = 0;
+
+    ownedTask cancelled = ownedReadTask(ring, 4, cancelledRead);
+    cancelled.handle.destroy();
+    readTask(ring, 4, readBytes, read);
+    writeTask(ring, sequence(4, 'A'), written);
+    CHECK_EQUAL(0, cancelledRead);
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(4, 'A') == readBytes);
+}
+
+TEST(CircularBufferAsync, destroyedWriterIsRemovedFromQueue)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int cancelledWrite = 0, written = 0, read = 0;
+
+    writeTask(ring, sequence(bufferSize - 1, 'a'), written);
+    ownedTask cancelled = ownedWriteTask(ring, sequence(5, 'A'), cancelledWrite);
+    cancelled.handle.destroy();
+    writeTask(ring, sequence(3, 'X'), written);
+    readTask(ring, bufferSize - 1 + 3, readBytes, read);
+    CHECK_EQUAL(0, cancelledWrite);
+    CHECK_EQUAL(1, read);
+    std::vector<uint8_t> expected = sequence(bufferSize - 1, 'a');
+    expected.insert(expected.end(), {'X', 'Y', 'Z'});
+    CHECK(expected == readBytes);
+}
+
+TEST(CircularBufferAsync, transfersBiggerThanTheBufferDoNotGrowTheStack)
+{
+    //each side keeps resuming the other: this must not nest on the stack
+    const size_t nWrites = 99999;
+    AsyncCircularBuffer ring(circularBuffer);
+    size_t errors = 0;
+    int written = 0, read = 0;
+
+    loopReadTask(ring, nWrites * 20 / 30, 30, errors, read);
+    loopWriteTask(ring, nWrites, 20, written);
+    CHECK_EQUAL(1, written);
+    CHECK_EQUAL(1, read);
+    CHECK_EQUAL(0, errors);
+}
+
+TEST(CircularBufferAsync, destroyedPartlyServedReaderLosesTheBytesItTook)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int written = 0, cancelledRead = 0, read = 0;
+
+    ownedTask cancelled = ownedReadTask(ring, 5, cancelledRead);
+    writeTask(ring, sequence(2, 'A'), written);
+    CHECK_EQUAL(1, CircularBufferIsEmpty(&circularBuffer));
+    cancelled.handle.destroy();
+    writeTask(ring, sequence(2, 'C'), written);
+    readTask(ring, 2, readBytes, read);
+    CHECK_EQUAL(0, cancelledRead);
+    CHECK_EQUAL(1, read);
+    CHECK(sequence(2, 'C') == readBytes);
+}
+
+TEST(CircularBufferAsync, destroyedPartlyServedWriterLeavesTheBytesItWrote)
+{
+    AsyncCircularBuffer ring(circularBuffer);
+    std::vector<uint8_t> readBytes;
+    int cancelledWrite = 0, written = 0, read = 0;
+
+    ownedTask cancelled = ownedWriteTask(ring, sequence(12, 'a'), cancelledWrite);
+    cancelled.handle.destroy();
+    writeTask(ring, sequence(bufferSize - 1, 'A'), written);
+    readTask(ring, 2 * (bufferSize - 1), readBytes, read);
+    CHECK_EQUAL(0, cancelledWrite);
+    CHECK_EQUAL(1, read);
+    std::vector<uint8_t> expected = sequence(bufferSize - 1, 'a');
+    std::vector<uint8_t> next = sequence(bufferSize - 1, 'A');
+    expected.insert(expected.end(), next.begin(), next.end());
+    CHECK(expected == readBytes);
+}
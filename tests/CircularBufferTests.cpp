@@ -329,4 +329,80 @@ TEST(CircularBufferBasic, bufferWithWrappingReturnsCorrectFreeSpace){
     }
     //now the buffer should have bufferSize - 1 - bufferSize/2 - 2 bytes free
     CHECK_EQUAL(bufferSize - 1 - bufferSize/2 - 2, CircularBufferFreeSpace(&circularBuffer));
-}
\ No newline at end of file
+}
+
+TEST(CircularBufferBasic, crcOfReadableBytesIsCorrect){
+    uint8_t writeBuffer[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    uint32_t crc = 0;
+    CircularBufferWriteNBytes(&circularBuffer, writeBuffer, 9);
+    CHECK_EQUAL(0, CircularBufferCrc32c(&circularBuffer, 0, 9, &crc));
+    UNSIGNED_LONGS_EQUAL(0xE3069283, crc);
+}
+
+TEST(CircularBufferBasic, crcDoesNotConsumeBytes){
+    uint32_t crc = 0;
+    CircularBufferWriteByte(&circularBuffer, 'A');
+    CircularBufferCrc32c(&circularBuffer, 0, 1, &crc);
+    CHECK_EQUAL(0, CircularBufferIsEmpty(&circularBuffer));
+    BYTES_EQUAL('A', CircularBufferReadByte(&circularBuffer));
+}
+
+TEST(CircularBufferBasic, crcOfWrappedRangeIsCorrect){
+    uint8_t writeBuffer[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    uint32_t crc = 0;
+    //move both pointers to the middle of the buffer
+    for(int i = 0; i < bufferSize / 2; i++){
+        CircularBufferWriteByte(&circularBuffer, 'a');
+        CircularBufferReadByte(&circularBuffer);
+    }
+    CircularBufferWriteNBytes(&circularBuffer, writeBuffer, 9);
+    CHECK_EQUAL(0, CircularBufferCrc32c(&circularBuffer, 0, 9, &crc));
+    UNSIGNED_LONGS_EQUAL(0xE3069283, crc);
+}
+
+TEST(CircularBufferBasic, crcCanBeComputedInChunks){
+    uint8_t writeBuffer[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    uint32_t crc = 0;
+    for(int i = 0; i < bufferSize / 2; i++){
+        CircularBufferWriteByte(&circularBuffer, 'a');
+        CircularBufferReadByte(&circularBuffer);
+    }
+    CircularBufferWriteNBytes(&circularBuffer, writeBuffer, 9);
+    CHECK_EQUAL(0, CircularBufferCrc32c(&circularBuffer, 0, 3, &crc));
+    CHECK_EQUAL(0, CircularBufferCrc32c(&circularBuffer, 3, 6, &crc));
+    UNSIGNED_LONGS_EQUAL(0xE3069283, crc);
+}
+
+TEST(CircularBufferBasic, crcOfRangeBeyondReadableBytesFails){
+    uint32_t crc = 0x1234;
+    CircularBufferWriteByte(&circularBuffer, 'A');
+    CircularBufferWriteByte(&circularBuffer, 'B');
+    CHECK_EQUAL(-1, CircularBufferCrc32c(&circularBuffer, 0, 3, &crc));
+    CHECK_EQUAL(-1, CircularBufferCrc32c(&circularBuffer, 3, 0, &crc));
+    CHECK_EQUAL(-1, CircularBufferCrc32c(&circularBuffer, 1, 2, &crc));
+    UNSIGNED_LONGS_EQUAL(0x1234, crc);
+}
+
+TEST(CircularBufferBasic, writeCrcIsNotUpdatedUntilStarted){
+    CircularBufferWriteByte(&circularBuffer, 'A');
+    UNSIGNED_LONGS_EQUAL(0, CircularBufferGetWriteCrc(&circularBuffer));
+}
+
+TEST(CircularBufferBasic, writeCrcFollowsWrittenBytes){
+    uint8_t writeBuffer[9] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    CircularBufferWriteByte(&circularBuffer, 'A');
+    CircularBufferStartWriteCrc(&circularBuffer);
+    CircularBufferWriteNBytes(&circularBuffer, writeBuffer, 9);
+    CircularBufferStopWriteCrc(&circularBuffer);
+    CircularBufferWriteByte(&circularBuffer, 'B');
+    UNSIGNED_LONGS_EQUAL(0xE3069283, CircularBufferGetWriteCrc(&circularBuffer));
+}
+
+TEST(CircularBufferBasic, writeCrcMixesSingleAndMultipleByteWrites){
+    uint8_t writeBuffer[7] = {'2', '3', '4', '5', '6', '7', '8'};
+    CircularBufferStartWriteCrc(&circularBuffer);
+    CircularBufferWriteByte(&circularBuffer, '1');
+    CircularBufferWriteNBytes(&circularBuffer, writeBuffer, 7);
+    CircularBufferWriteByte(&circularBuffer, '9');
+    UNSIGNED_LONGS_EQUAL(0xE3069283, CircularBufferGetWriteCrc(&circularBuffer));
+}
@@ -0,0 +1,106 @@
+#include "CppUTest/TestHarness.h"   // IWYU pragma: keep
+#include "CppUTest/UtestMacros.h"
+#include <cstdint>
+#include <cstring>
+
+
+
+extern "C"
+{
+	#include "Crc32c.h"
+}
+
+TEST_GROUP(Crc32c)
+{
+    void setup()
+    {
+    }
+
+    void teardown()
+    {
+    }
+};
+
+TEST(Crc32c, emptyInputLeavesCrcUnchanged)
+{
+    UNSIGNED_LONGS_EQUAL(0, Crc32cUpdate(0, NULL, 0));
+    UNSIGNED_LONGS_EQUAL(0x12345678, Crc32cUpdate(0x12345678, NULL, 0));
+    UNSIGNED_LONGS_EQUAL(0, Crc32cUpdateSoftware(0, NULL, 0));
+    UNSIGNED_LONGS_EQUAL(0x12345678, Crc32cUpdateSoftware(0x12345678, NULL, 0));
+}
+
+TEST(Crc32c, checkValueIsCorrect)
+{
+    const uint8_t data[] = "123456789";
+    UNSIGNED_LONGS_EQUAL(0xE3069283, Crc32cUpdate(0, data, 9));
+    UNSIGNED_LONGS_EQUAL(0xE3069283, Crc32cUpdateSoftware(0, data, 9));
+}
+
+TEST(Crc32c, thirtyTwoZerosAreCorrect)
+{
+    uint8_t data[32];
+    memset(data, 0, sizeof(data));
+    UNSIGNED_LONGS_EQUAL(0x8A9136AA, Crc32cUpdate(0, data, sizeof(data)));
+    UNSIGNED_LONGS_EQUAL(0x8A9136AA, Crc32cUpdateSoftware(0, data, sizeof(data)));
+}
+
+TEST(Crc32c, chunkedCrcEqualsWholeCrc)
+{
+    uint8_t data[100];
+    for(int i = 0; i < 100; i++){
+        data[i] = i * 7 + 3;
+    }
+    uint32_t whole = Crc32cUpdate(0, data, sizeof(data));
+    UNSIGNED_LONGS_EQUAL(whole, Crc32cUpdateSoftware(0, data, sizeof(data)));
+    for(int split = 0; split <= 100; split++){
+        uint32_t crc = Crc32cUpdate(0, data, split);
+        crc = Crc32cUpdate(crc, data + split, 100 - split);
+        UNSIGNED_LONGS_EQUAL(whole, crc);
+
+        crc = Crc32cUpdateSoftware(0, data, split);
+        crc = Crc32cUpdateSoftware(crc, data + split, 100 - split);
+        UNSIGNED_LONGS_EQUAL(whole, crc);
+    }
+}
+
+TEST(Crc32c, softwareAndDefaultPathsAgree)
+{
+    //every length up to 40 covers the 8 byte loop with every tail length,
+    //every start covers unaligned data
+    uint8_t data[48];
+    for(int i = 0; i < 48; i++){
+        data[i] = i * 151 + 17;
+    }
+    for(int start = 0; start < 8; start++){
+        for(int length = 0; length <= 40; length++){
+            UNSIGNED_LONGS_EQUAL(Crc32cUpdate(0xFFFFFFFF, data + start, length),
+                                 Crc32cUpdateSoftware(0xFFFFFFFF, data + start, length));
+        }
+    }
+}
+
+TEST(Crc32c, softwareAndDefaultPathsAgreeOnLargeBuffer)
+{
+    //enough pseudo random data to index every entry of the slice-by-8 tables
+    static uint8_t data[65536];
+    uint32_t x = 0x9E3779B9;
+    for(size_t i = 0; i < sizeof(data); i++){
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        data[i] = x;
+    }
+    UNSIGNED_LONGS_EQUAL(Crc32cUpdate(0, data, sizeof(data)),
+                         Crc32cUpdateSoftware(0, data, sizeof(data)));
+}
+
+TEST(Crc32c, registerAndByteStepMatchCrc)
+{
+    const uint8_t data[] = "123456789";
+    uint32_t reg = 0xFFFFFFFF;
+    for(int i = 0; i < 9; i++){
+        reg = Crc32cStepByte(reg, data[i]);
+    }
+    UNSIGNED_LONGS_EQUAL(0xE3069283, ~reg);
+    UNSIGNED_LONGS_EQUAL(0xE3069283, ~Crc32cUpdateRegister(0xFFFFFFFF, data, 9));
+}
@@ -0,0 +1,488 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "CircularBuffer.h"
+#include "Crc32c.h"
+
+#define MAX_PRODUCERS 16
+#define MAX_CONSUMERS 16
+#define MAX_CHUNK 16
+#define MAX_REPORTED_ERRORS 10
+
+#define DEFAULT_BUFFER_SIZE 256
+#define DEFAULT_BYTES_PER_PRODUCER (1 << 18)
+#define DEFAULT_MODEL_BYTES_PER_PRODUCER 4096
+#define DEFAULT_MODEL_SEEDS 16
+
+typedef struct{
+    int producers;
+    int consumers;
+    size_t bufferSize;
+    size_t bytesPerProducer;
+    int overwrite;
+    uint32_t seed;
+}stressConfig_t;
+
+/* Every byte carries the id of its producer in the low bits and the
+   producer's sequence number modulo seqModulo in the high bits. */
+typedef struct{
+    int idBits;
+    unsigned seqModulo;
+}encoding_t;
+
+/* Per producer view of the bytes read so far, shared by all the consumers. */
+typedef struct{
+    unsigned expectedSeq;
+    size_t received;
+    size_t skipped;
+    size_t overwritesAtLastByte;
+}streamModel_t;
+
+typedef struct{
+    const stressConfig_t *pConfig;
+    encoding_t encoding;
+    circularBuffer_t circularBuffer;
+    size_t chunk;
+
+    pthread_mutex_t producersMutex;
+    int producersRunning;
+    atomic_size_t overwrites;
+
+    pthread_mutex_t consumersMutex;
+    streamModel_t streams[MAX_PRODUCERS];
+    size_t errors;
+}stressRun_t;
+
+typedef struct{
+    stressRun_t *pRun;
+    int index;
+}threadArgs_t;
+
+static int runThreaded(const stressConfig_t *pConfig);
+static int runModel(const stressConfig_t *pConfig);
+static void *producerThread(void *arg);
+static void *consumerThread(void *arg);
+static void checkByte(stressRun_t *pRun, uint8_t byte, size_t overwritesBeforeRead);
+static encoding_t makeEncoding(int producers);
+static uint8_t encode(const encoding_t *pEncoding, int producer, size_t seq);
+static uint32_t nextRandom(uint32_t *pState);
+static double elapsedSeconds(const struct timespec *pStart);
+static void usage(const char *name);
+
+int main(int argc, char **argv){
+    stressConfig_t config = {1, 1, DEFAULT_BUFFER_SIZE, 0, 0, 1};
+    int model = 0;
+    int failures = 0;
+    int opt;
+
+    if(argc == 1){
+        static const stressConfig_t threadedConfigs[] = {
+            {1, 1, DEFAULT_BUFFER_SIZE, DEFAULT_BYTES_PER_PRODUCER, 0, 1},
+            {4, 1, DEFAULT_BUFFER_SIZE, DEFAULT_BYTES_PER_PRODUCER, 0, 2},
+            {1, 4, DEFAULT_BUFFER_SIZE, DEFAULT_BYTES_PER_PRODUCER, 0, 3},
+            {4, 4, DEFAULT_BUFFER_SIZE, DEFAULT_BYTES_PER_PRODUCER, 0, 4},
+            {2, 2, 16, DEFAULT_BYTES_PER_PRODUCER, 1, 5},
+            {1, 1, 4096, DEFAULT_BYTES_PER_PRODUCER, 1, 6},
+            {2, 2, 4096, DEFAULT_BYTES_PER_PRODUCER, 1, 7},
+        };
+        static const stressConfig_t modelConfigs[] = {
+            {2, 2, 8, DEFAULT_MODEL_BYTES_PER_PRODUCER, 0, 0},
+            {3, 2, 8, DEFAULT_MODEL_BYTES_PER_PRODUCER, 1, 0},
+        };
+
+        printf("Stress tests\n");
+        for(size_t i = 0; i < sizeof(threadedConfigs) / sizeof(threadedConfigs[0]); i++){
+            failures += runThreaded(&threadedConfigs[i]);
+        }
+        for(size_t i = 0; i < sizeof(modelConfigs) / sizeof(modelConfigs[0]); i++){
+            config = modelConfigs[i];
+            for(uint32_t seed = 1; seed <= DEFAULT_MODEL_SEEDS; seed++){
+                config.seed = seed;
+                failures += runModel(&config);
+            }
+        }
+        printf("%d failed configurations\n", failures);
+        return failures ? 1 : 0;
+    }
+
+    while((opt = getopt(argc, argv, "p:c:n:s:r:om")) != -1){
+        switch(opt){
+            case 'p': config.producers = atoi(optarg); break;
+            case 'c': config.consumers = atoi(optarg); break;
+            case 'n': config.bytesPerProducer = strtoul(optarg, NULL, 0); break;
+            case 's': config.bufferSize = strtoul(optarg, NULL, 0); break;
+            case 'r': config.seed = strtoul(optarg, NULL, 0); break;
+            case 'o': config.overwrite = 1; break;
+            case 'm': model = 1; break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+    if(config.bytesPerProducer == 0){
+        config.bytesPerProducer = model ? DEFAULT_MODEL_BYTES_PER_PRODUCER : DEFAULT_BYTES_PER_PRODUCER;
+    }
+    if(config.producers < 1 || config.producers > MAX_PRODUCERS ||
+       config.consumers < 1 || config.consumers > MAX_CONSUMERS ||
+       config.bufferSize < (size_t)config.producers + 1){
+        usage(argv[0]);
+        return 2;
+    }
+
+    failures = model ? runModel(&config) : runThreaded(&config);
+    return failures ? 1 : 0;
+}
+
+/* Producers and consumers on their own threads, at full speed.
+   Consumers share a mutex because checking CircularBufferIsEmpty and then
+   calling CircularBufferReadByte is not atomic; the same mutex orders the
+   reads, so every byte can be checked against the per producer sequence.
+   As a consequence only one consumer reads at a time: with more consumers
+   the reads contend on that mutex, they do not run in parallel.
+   In lossless mode a producer writes a chunk only if there is room for it
+   plus a full chunk for every other producer, so nothing may be overwritten.
+   The seed drives the chunk sizes and where the threads yield; the thread
+   scheduling itself is up to the OS, so a run is not reproducible. */
+static int runThreaded(const stressConfig_t *pConfig){
+    stressRun_t run;
+    threadArgs_t producerArgs[MAX_PRODUCERS];
+    threadArgs_t consumerArgs[MAX_CONSUMERS];
+    pthread_t producers[MAX_PRODUCERS];
+    pthread_t consumers[MAX_CONSUMERS];
+    uint8_t *buffer;
+    size_t totalWritten, totalReceived = 0, totalSkipped = 0, overwrites;
+    struct timespec start;
+    double seconds;
+    int i;
+
+    memset(&run, 0, sizeof(run));
+    run.pConfig = pConfig;
+    run.encoding = makeEncoding(pConfig->producers);
+    run.chunk = (pConfig->bufferSize - 1) / pConfig->producers;
+    if(run.chunk > MAX_CHUNK){
+        run.chunk = MAX_CHUNK;
+    }
+    run.producersRunning = pConfig->producers;
+    atomic_init(&run.overwrites, 0);
+    pthread_mutex_init(&run.producersMutex, NULL);
+    pthread_mutex_init(&run.consumersMutex, NULL);
+
+    buffer = malloc(pConfig->bufferSize);
+    CircularBufferInit(&run.circularBuffer, buffer, pConfig->bufferSize);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < pConfig->consumers; i++){
+        consumerArgs[i].pRun = &run;
+        consumerArgs[i].index = i;
+        pthread_create(&consumers[i], NULL, consumerThread, &consumerArgs[i]);
+    }
+    for(i = 0; i < pConfig->producers; i++){
+        producerArgs[i].pRun = &run;
+        producerArgs[i].index = i;
+        pthread_create(&producers[i], NULL, producerThread, &producerArgs[i]);
+    }
+    for(i = 0; i < pConfig->producers; i++){
+        pthread_join(producers[i], NULL);
+    }
+    for(i = 0; i < pConfig->consumers; i++){
+        pthread_join(consumers[i], NULL);
+    }
+    seconds = elapsedSeconds(&start);
+    overwrites = atomic_load(&run.overwrites);
+
+    totalWritten = pConfig->bytesPerProducer * pConfig->producers;
+    for(i = 0; i < pConfig->producers; i++){
+        totalReceived += run.streams[i].received;
+        totalSkipped += run.streams[i].skipped;
+        if(run.streams[i].received > pConfig->bytesPerProducer ||
+           (!pConfig->overwrite && run.streams[i].received != pConfig->bytesPerProducer)){
+            printf("  producer %d: %zu bytes written, %zu received\n",
+                   i, pConfig->bytesPerProducer, run.streams[i].received);
+            run.errors++;
+        }
+    }
+    if(!pConfig->overwrite && overwrites != 0){
+        printf("  %zu overwrites reported in lossless mode\n", overwrites);
+        run.errors++;
+    }
+    if(totalReceived + overwrites != totalWritten){
+        printf("  %zu bytes written, %zu received, %zu overwritten\n",
+               totalWritten, totalReceived, overwrites);
+        run.errors++;
+    }
+    if(totalSkipped > overwrites){
+        printf("  %zu bytes missing from the sequences, only %zu overwrites reported\n",
+               totalSkipped, overwrites);
+        run.errors++;
+    }
+
+    printf("threads P=%d C=%d buf=%zu %s seed=%u: %zu bytes in %.3f s, %.2f MB/s, %.1f ns/byte, %zu overwrites %s\n",
+           pConfig->producers, pConfig->consumers, pConfig->bufferSize,
+           pConfig->overwrite ? "overwrite" : "lossless", pConfig->seed,
+           totalWritten, seconds, totalWritten / seconds / 1e6, seconds * 1e9 / totalWritten,
+           overwrites, run.errors ? "FAILED" : "OK");
+
+    pthread_mutex_destroy(&run.producersMutex);
+    pthread_mutex_destroy(&run.consumersMutex);
+    free(buffer);
+    return run.errors ? 1 : 0;
+}
+
+static void *producerThread(void *arg){
+    threadArgs_t *pArgs = (threadArgs_t *)arg;
+    stressRun_t *pRun = pArgs->pRun;
+    const stressConfig_t *pConfig = pRun->pConfig;
+    uint32_t randomState = pConfig->seed * 2654435761u + pArgs->index * 2 + 1;
+    size_t reserve = pRun->chunk * (pConfig->producers - 1);
+    uint8_t bytes[MAX_CHUNK];
+    size_t seq = 0, n;
+    int retVal;
+
+    while(seq < pConfig->bytesPerProducer){
+        n = 1 + nextRandom(&randomState) % pRun->chunk;
+        if(n > pConfig->bytesPerProducer - seq){
+            n = pConfig->bytesPerProducer - seq;
+        }
+        if(!pConfig->overwrite && CircularBufferFreeSpace(&pRun->circularBuffer) < n + reserve){
+            sched_yield();
+            continue;
+        }
+        for(size_t i = 0; i < n; i++){
+            bytes[i] = encode(&pRun->encoding, pArgs->index, seq + i);
+        }
+        retVal = CircularBufferWriteNBytes(&pRun->circularBuffer, bytes, n);
+        if(retVal != 0){
+            //published right away, the consumers check every gap against it
+            atomic_fetch_add(&pRun->overwrites, -retVal);
+        }
+        seq += n;
+        if(nextRandom(&randomState) % 32 == 0){
+            sched_yield();
+        }
+    }
+
+    pthread_mutex_lock(&pRun->producersMutex);
+    pRun->producersRunning--;
+    pthread_mutex_unlock(&pRun->producersMutex);
+    return 0;
+}
+
+static void *consumerThread(void *arg){
+    threadArgs_t *pArgs = (threadArgs_t *)arg;
+    stressRun_t *pRun = pArgs->pRun;
+    uint32_t randomState = pRun->pConfig->seed * 2246822519u + pArgs->index * 2 + 1;
+    int producersRunning, isEmpty;
+    size_t overwritesBeforeRead;
+
+    while(1){
+        pthread_mutex_lock(&pRun->producersMutex);
+        producersRunning = pRun->producersRunning;
+        pthread_mutex_unlock(&pRun->producersMutex);
+
+        pthread_mutex_lock(&pRun->consumersMutex);
+        isEmpty = CircularBufferIsEmpty(&pRun->circularBuffer);
+        while(!isEmpty){
+            overwritesBeforeRead = atomic_load(&pRun->overwrites);
+            checkByte(pRun, CircularBufferReadByte(&pRun->circularBuffer), overwritesBeforeRead);
+            if(nextRandom(&randomState) % 8 == 0){
+                break;
+            }
+            isEmpty = CircularBufferIsEmpty(&pRun->circularBuffer);
+        }
+        pthread_mutex_unlock(&pRun->consumersMutex);
+
+        if(isEmpty && !producersRunning){
+            break;
+        }
+        if(isEmpty || nextRandom(&randomState) % 32 == 0){
+            sched_yield();
+        }
+    }
+    return 0;
+}
+
+/* Called with consumersMutex held. In lossless mode every byte must be the next
+   one of its producer. With overwrites, bytes may be missing, but the gap since
+   the previous byte of the same producer cannot be bigger than the overwrites
+   reported in the meantime, plus a chunk per producer for the writes that are
+   still in progress and have not reported their overwrites yet. "In the meantime"
+   starts before the previous byte was read: counting from after it could include
+   the overwrites that removed the bytes of this gap. A duplicated or
+   reordered byte shows up as a gap of almost seqModulo, so it is detected as long
+   as overwrites are rare compared to seqModulo, e.g. with a big buffer. */
+static void checkByte(stressRun_t *pRun, uint8_t byte, size_t overwritesBeforeRead){
+    const encoding_t *pEncoding = &pRun->encoding;
+    int producer = byte & ((1 << pEncoding->idBits) - 1);
+    unsigned seq = byte >> pEncoding->idBits;
+    streamModel_t *pStream;
+    size_t overwrites, allowedGap;
+    unsigned gap;
+
+    if(producer >= pRun->pConfig->producers){
+        if(pRun->errors++ < MAX_REPORTED_ERRORS){
+            printf("  read 0x%02X, not written by any producer\n", byte);
+        }
+        return;
+    }
+    pStream = &pRun->streams[producer];
+    gap = (seq + pEncoding->seqModulo - pStream->expectedSeq) % pEncoding->seqModulo;
+    if(pRun->pConfig->overwrite){
+        overwrites = atomic_load(&pRun->overwrites);
+        allowedGap = overwrites - pStream->overwritesAtLastByte + pRun->pConfig->producers * pRun->chunk;
+        pStream->overwritesAtLastByte = overwritesBeforeRead;
+    }else{
+        allowedGap = 0;
+    }
+    if(gap > allowedGap){
+        if(pRun->errors++ < MAX_REPORTED_ERRORS){
+            printf("  producer %d byte %zu: expected sequence %u, read %u, %zu bytes may be missing (lost, duplicated or reordered)\n",
+                   producer, pStream->received, pStream->expectedSeq, seq, allowedGap);
+        }
+    }
+    pStream->skipped += gap;
+    pStream->expectedSeq = (seq + 1) % pEncoding->seqModulo;
+    pStream->received++;
+}
+
+/* Randomized sequential model test: producers and consumers are stepped one
+   operation at a time from a single thread, in an order drawn from the seed,
+   and every result is compared against a reference queue. It checks the
+   behaviour of every interleaving of whole API calls it visits, not races
+   inside the calls, which are left to the threaded mode. A failure is
+   reproduced by running again with -m and the same parameters and seed. */
+static int runModel(const stressConfig_t *pConfig){
+    encoding_t encoding = makeEncoding(pConfig->producers);
+    size_t capacity = pConfig->bufferSize - 1;
+    size_t written[MAX_PRODUCERS] = {0};
+    size_t finished = 0, head = 0, count = 0, steps = 0, offset, length, i;
+    uint32_t randomState = pConfig->seed;
+    uint32_t crc, expectedCrc;
+    uint8_t *buffer = malloc(pConfig->bufferSize);
+    uint8_t *model = malloc(capacity);
+    uint8_t byte;
+    circularBuffer_t circularBuffer;
+    struct timespec start;
+    double seconds;
+    int actor, retVal, expectedRetVal, errors = 0;
+
+    CircularBufferInit(&circularBuffer, buffer, pConfig->bufferSize);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while(!errors && (finished < (size_t)pConfig->producers || count > 0)){
+        steps++;
+        actor = nextRandom(&randomState) % (pConfig->producers + pConfig->consumers);
+        if(actor < pConfig->producers){
+            if(written[actor] == pConfig->bytesPerProducer || (!pConfig->overwrite && count == capacity)){
+                continue;
+            }
+            byte = encode(&encoding, actor, written[actor]);
+            expectedRetVal = 0;
+            if(count == capacity){
+                head = (head + 1) % capacity;
+                count--;
+                expectedRetVal = -1;
+            }
+            model[(head + count) % capacity] = byte;
+            count++;
+            retVal = CircularBufferWriteByte(&circularBuffer, byte);
+            if(retVal != expectedRetVal){
+                printf("  step %zu: producer %d write returned %d, expected %d\n", steps, actor, retVal, expectedRetVal);
+                errors++;
+            }
+            if(++written[actor] == pConfig->bytesPerProducer){
+                finished++;
+            }
+        }else{
+            if(CircularBufferIsEmpty(&circularBuffer) != (count == 0)){
+                printf("  step %zu: buffer reports empty=%d with %zu bytes in the model\n",
+                       steps, CircularBufferIsEmpty(&circularBuffer), count);
+                errors++;
+            }else if(count > 0){
+                byte = CircularBufferReadByte(&circularBuffer);
+                if(byte != model[head]){
+                    printf("  step %zu: consumer %d read 0x%02X, expected 0x%02X\n",
+                           steps, actor - pConfig->producers, byte, model[head]);
+                    errors++;
+                }
+                head = (head + 1) % capacity;
+                count--;
+            }
+        }
+
+        if(CircularBufferFreeSpace(&circularBuffer) != capacity - count){
+            printf("  step %zu: free space %zu, expected %zu\n",
+                   steps, CircularBufferFreeSpace(&circularBuffer), capacity - count);
+            errors++;
+        }
+        if(nextRandom(&randomState) % 64 == 0){
+            offset = nextRandom(&randomState) % (count + 1);
+            length = nextRandom(&randomState) % (count - offset + 1);
+            crc = 0;
+            expectedCrc = 0;
+            for(i = 0; i < length; i++){
+                expectedCrc = Crc32cUpdate(expectedCrc, &model[(head + offset + i) % capacity], 1);
+            }
+            if(CircularBufferCrc32c(&circularBuffer, offset, length, &crc) != 0 || crc != expectedCrc){
+                printf("  step %zu: crc of %zu bytes at %zu is 0x%08X, expected 0x%08X\n",
+                       steps, length, offset, crc, expectedCrc);
+                errors++;
+            }
+        }
+    }
+    seconds = elapsedSeconds(&start);
+
+    printf("model   P=%d C=%d buf=%zu %s seed=%u: %zu steps in %.3f s, %.2f Msteps/s %s\n",
+           pConfig->producers, pConfig->consumers, pConfig->bufferSize,
+           pConfig->overwrite ? "overwrite" : "lossless", pConfig->seed,
+           steps, seconds, steps / seconds / 1e6, errors ? "FAILED" : "OK");
+
+    free(model);
+    free(buffer);
+    return errors ? 1 : 0;
+}
+
+static encoding_t makeEncoding(int producers){
+    encoding_t encoding;
+    encoding.idBits = 0;
+    while((1 << encoding.idBits) < producers){
+        encoding.idBits++;
+    }
+    encoding.seqModulo = 256 >> encoding.idBits;
+    return encoding;
+}
+
+static uint8_t encode(const encoding_t *pEncoding, int producer, size_t seq){
+    return (uint8_t)(((seq % pEncoding->seqModulo) << pEncoding->idBits) | producer);
+}
+
+/* xorshift32, so that every thread has its own reproducible sequence */
+static uint32_t nextRandom(uint32_t *pState){
+    uint32_t x = *pState ? *pState : 0x9E3779B9u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *pState = x;
+    return x;
+}
+
+static double elapsedSeconds(const struct timespec *pStart){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - pStart->tv_sec) + (now.tv_nsec - pStart->tv_nsec) / 1e9;
+}
+
+static void usage(const char *name){
+    printf("usage: %s [-p producers] [-c consumers] [-n bytes per producer] [-s buffer size] [-r seed] [-o] [-m]\n", name);
+    printf("  -o  overwrite mode: producers do not wait for free space\n");
+    printf("  -m  randomized sequential model test: a single thread steps producers and consumers\n");
+    printf("      in an order drawn from the seed and checks every call against a reference queue;\n");
+    printf("      reproducible, but it does not exercise concurrent execution\n");
+    printf("  -r  in the threaded mode the seed only drives chunk sizes and yields, runs are not reproducible\n");
+    printf("  consumers read under a shared mutex, so more consumers contend, they do not read in parallel\n");
+    printf("  without arguments a default set of configurations is run\n");
+}